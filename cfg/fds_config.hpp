@@ -30,9 +30,10 @@ extern "C" {
 #endif
 
 /**
- * @brief Defines the number of supported parameters.
+ * @brief Defines the number of supported parameters. flashtest reserves the
+ * last one for batches, see FDSSTORE_BATCH_ID.
  */
-#define FDS_NUM_RECORDS                 4
+#define FDS_NUM_RECORDS                 5
 
 /**
  * @brief Defines the number of used flash pages. Currently the section used by
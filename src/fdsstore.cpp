@@ -0,0 +1,487 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#include "fdsstore.hpp"
+#include "rle.hpp"
+#include "scratch.hpp"
+
+#include "fds/fds.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Number of overhead bytes Fds adds to every record, see 
+ * FDS_MAX_DATABYTES.
+ */
+#define FDS_RECORD_OVERHEAD             6
+
+/**
+ * @brief The batch record starts with a magic number and a version, records
+ * without them are never applied.
+ */
+#define BATCH_MAGIC                     0x42
+#define BATCH_VERSION                   0x01
+#define BATCH_HDRSIZ                    2
+
+/**
+ * @brief Number of header bytes per record in a batch.
+ */
+#define BATCH_RECHDRSIZ                 3
+
+/**
+ * @brief Returns the number of halfwords Fds programs for a record.
+ */
+static uint32_t recordHalfWords(size_t siz)
+{
+    return (FDS_RECORD_OVERHEAD + siz + 1) / 2;
+}
+
+/**
+ * @brief Returns the number of user data bytes of a stored record.
+ */
+static size_t rawSize(const uint8_t *pRec, size_t siz)
+{
+    if (siz == 0)
+        return 0;
+
+    if (pRec[0] == FDSSTORE_FLAG_RLE)
+        return rleSize(&pRec[1], siz - 1);
+
+    return siz - 1;
+}
+
+FdsStore::FdsStore() :
+     batchSiz(0)
+    ,batchActive(false)
+    ,batchPending(false)
+    ,writes(0)
+    ,rawHalfWords(0)
+    ,storedHalfWords(0)
+    ,batchHalfWords(0)
+    ,unchanged(0)
+{
+
+}
+
+int8_t FdsStore::mount(void)
+{
+    Fds *pFds = pFds->getInstance();
+
+    batchActive = false;
+    batchSiz = pFds->read(FDSSTORE_BATCH_ID, batch, sizeof(batch));
+
+    /* Anything else stored at this id is not a batch and is left untouched. */
+    if (batchSiz < BATCH_HDRSIZ || batch[0] != BATCH_MAGIC || 
+        batch[1] != BATCH_VERSION)
+    {
+        batchSiz = 0;
+        return 0;
+    }
+
+    batchPending = true;
+
+    return apply();
+}
+
+int8_t FdsStore::begin(void)
+{
+    if (batchActive)
+        return -1;
+
+    if (finish() != 0)
+        return -2;
+
+    batchActive = true;
+    batch[0] = BATCH_MAGIC;
+    batch[1] = BATCH_VERSION;
+    batchSiz = BATCH_HDRSIZ;
+
+    return 0;
+}
+
+int8_t FdsStore::commit(void)
+{
+    int8_t cnt = 0;
+    int8_t ret = 0;
+
+    if (!batchActive)
+        return -1;
+
+    batchActive = false;
+
+    cnt = compact();
+    if (cnt < 0)
+        return -3;
+
+    /* A single record is atomic anyway, it needs no batch record. */
+    if (cnt <= 1)
+    {
+        if (cnt == 1)
+        {
+            ret = put(batch[BATCH_HDRSIZ], 
+                &batch[BATCH_HDRSIZ + BATCH_RECHDRSIZ], 
+                batchSiz - BATCH_HDRSIZ - BATCH_RECHDRSIZ);
+        }
+
+        batchSiz = 0;
+        return ret;
+    }
+
+    /* Once this record is written the batch is committed. */
+    if (store(FDSSTORE_BATCH_ID, batch, batchSiz) != 0)
+        return -2;
+
+    /* If applying fails it is retried by the next access or mount. */
+    batchPending = true;
+    apply();
+
+    return 0;
+}
+
+void FdsStore::abort(void)
+{
+    batchActive = false;
+    batchSiz = 0;
+}
+
+int8_t FdsStore::write(uint8_t id, const void *pData, size_t siz, 
+    bool compress)
+{
+    uint8_t *pBuf = 0;
+    size_t len = 0;
+    int8_t ret = 0;
+
+    if (id >= FDSSTORE_NUM_RECORDS)
+        return -1;
+
+    if (siz > FDSSTORE_MAX_DATABYTES)
+        return -2;
+
+    if (finish() != 0)
+        return -5;
+
+    pBuf = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    if (pBuf == 0)
+        return -4;
+
+    if (compress && siz > 1)
+        len = rleEncode((const uint8_t *) pData, siz, &pBuf[1], siz - 1);
+
+    if (len != 0)
+    {
+        pBuf[0] = FDSSTORE_FLAG_RLE;
+    }
+    else
+    {
+        pBuf[0] = FDSSTORE_FLAG_RAW;
+        memcpy(&pBuf[1], pData, siz);
+        len = siz;
+    }
+
+    len++;
+
+    if (batchActive)
+    {
+        if (batchSiz + BATCH_RECHDRSIZ + len > sizeof(batch))
+        {
+            ret = -3;
+        }
+        else
+        {
+            batch[batchSiz++] = id;
+            batch[batchSiz++] = len & 0xff;
+            batch[batchSiz++] = len >> 8;
+            memcpy(&batch[batchSiz], pBuf, len);
+            batchSiz += len;
+        }
+    }
+    else
+    {
+        ret = store(id, pBuf, len);
+    }
+
+    scratchFree(pBuf);
+
+    return ret;
+}
+
+size_t FdsStore::read(uint8_t id, void *pData, size_t siz)
+{
+    Fds *pFds = pFds->getInstance();
+    uint8_t *pBuf = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    size_t len = 0;
+
+    if (pBuf == 0)
+        return 0;
+
+    len = pFds->read(id, pBuf, FDS_MAX_DATABYTES);
+    if (len != 0)
+    {
+        switch (pBuf[0])
+        {
+            case FDSSTORE_FLAG_RAW:
+                len = len - 1 > siz ? 0 : len - 1;
+                memcpy(pData, &pBuf[1], len);
+                break;
+
+            case FDSSTORE_FLAG_RLE:
+                len = rleDecode(&pBuf[1], len - 1, (uint8_t *) pData, siz);
+                break;
+
+            default:
+                len = 0;
+                break;
+        }
+    }
+
+    scratchFree(pBuf);
+
+    return len;
+}
+
+int8_t FdsStore::del(uint8_t id)
+{
+    Fds *pFds = pFds->getInstance();
+
+    if (id >= FDSSTORE_NUM_RECORDS)
+        return -1;
+
+    if (finish() != 0)
+        return -2;
+
+    if (!batchActive)
+        return pFds->del(id);
+
+    /* Deletes are queued as records without data. */
+    if (batchSiz + BATCH_RECHDRSIZ > sizeof(batch))
+        return -3;
+
+    batch[batchSiz++] = id;
+    batch[batchSiz++] = 0;
+    batch[batchSiz++] = 0;
+
+    return 0;
+}
+
+int8_t FdsStore::finish(void)
+{
+    if (!batchPending)
+        return 0;
+
+    return apply();
+}
+
+int8_t FdsStore::put(uint8_t id, const uint8_t *pBuf, size_t siz)
+{
+    Fds *pFds = pFds->getInstance();
+
+    if (siz == 0)
+        return pFds->del(id);
+
+    return store(id, pBuf, siz);
+}
+
+int8_t FdsStore::store(uint8_t id, const uint8_t *pBuf, size_t siz)
+{
+    Fds *pFds = pFds->getInstance();
+    int8_t ret = 0;
+
+    ret = pFds->write(id, pBuf, siz);
+    if (ret != 0)
+        return ret;
+
+    if (id == FDSSTORE_BATCH_ID)
+    {
+        batchHalfWords += recordHalfWords(siz);
+    }
+    else
+    {
+        writes++;
+        storedHalfWords += recordHalfWords(siz);
+        rawHalfWords += recordHalfWords(rawSize(pBuf, siz));
+    }
+
+    return ret;
+}
+
+bool FdsStore::valid(void)
+{
+    size_t pos = BATCH_HDRSIZ;
+    size_t len = 0;
+
+    if (batchSiz < BATCH_HDRSIZ || batch[0] != BATCH_MAGIC || 
+        batch[1] != BATCH_VERSION)
+    {
+        return false;
+    }
+
+    while (pos < batchSiz)
+    {
+        if (pos + BATCH_RECHDRSIZ > batchSiz)
+            return false;
+
+        len = batch[pos + 1] | (batch[pos + 2] << 8);
+        if (batch[pos] >= FDSSTORE_NUM_RECORDS)
+            return false;
+
+        pos += BATCH_RECHDRSIZ + len;
+    }
+
+    return pos == batchSiz;
+}
+
+bool FdsStore::contains(uint8_t id, size_t pos)
+{
+    while (pos < batchSiz)
+    {
+        if (batch[pos] == id)
+            return true;
+
+        pos += BATCH_RECHDRSIZ + (batch[pos + 1] | (batch[pos + 2] << 8));
+    }
+
+    return false;
+}
+
+int8_t FdsStore::compact(void)
+{
+    Fds *pFds = pFds->getInstance();
+    uint8_t *pCur = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    size_t pos = BATCH_HDRSIZ;
+    size_t next = 0;
+    size_t len = 0;
+    uint8_t id = 0;
+    bool same = false;
+    int8_t cnt = 0;
+
+    if (pCur == 0)
+        return -1;
+
+    while (pos < batchSiz)
+    {
+        id = batch[pos];
+        len = batch[pos + 1] | (batch[pos + 2] << 8);
+        next = pos + BATCH_RECHDRSIZ + len;
+
+        same = pFds->read(id, pCur, FDS_MAX_DATABYTES) == len &&
+            memcmp(pCur, &batch[pos + BATCH_RECHDRSIZ], len) == 0;
+
+        if (same || contains(id, next))
+        {
+            if (same)
+                unchanged++;
+
+            memmove(&batch[pos], &batch[next], batchSiz - next);
+            batchSiz -= next - pos;
+        }
+        else
+        {
+            pos = next;
+            cnt++;
+        }
+    }
+
+    scratchFree(pCur);
+
+    return cnt;
+}
+
+int8_t FdsStore::apply(void)
+{
+    Fds *pFds = pFds->getInstance();
+    uint8_t *pCur = 0;
+    size_t pos = BATCH_HDRSIZ;
+    size_t len = 0;
+    uint8_t id = 0;
+
+    /* A corrupted batch is discarded before anything has been written. */
+    if (!valid())
+    {
+        batchSiz = 0;
+        batchPending = false;
+        pFds->del(FDSSTORE_BATCH_ID);
+        return -1;
+    }
+
+    pCur = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    if (pCur == 0)
+        return -4;
+
+    while (pos < batchSiz)
+    {
+        id = batch[pos];
+        len = batch[pos + 1] | (batch[pos + 2] << 8);
+        pos += BATCH_RECHDRSIZ;
+
+        /* After a reset some records might be written already. */
+        if (pFds->read(id, pCur, FDS_MAX_DATABYTES) == len &&
+            memcmp(pCur, &batch[pos], len) == 0)
+        {
+            unchanged++;
+        }
+        else if (put(id, &batch[pos], len) != 0)
+        {
+            /* Keep the batch record, the next mount will try again. */
+            scratchFree(pCur);
+            return -2;
+        }
+
+        pos += len;
+    }
+
+    scratchFree(pCur);
+
+    if (pFds->del(FDSSTORE_BATCH_ID) != 0)
+        return -3;
+
+    batchSiz = 0;
+    batchPending = false;
+
+    return 0;
+}
+
+void FdsStore::info(void)
+{
+    printf("  Writes:       %lu\n", writes);
+    printf("  Halfwords:    %lu programmed, %lu without compression\n", 
+        storedHalfWords, rawHalfWords);
+
+    if (rawHalfWords != 0)
+    {
+        printf("  Saved:        %ld%%\n", 
+            ((int32_t) (rawHalfWords - storedHalfWords) * 100) / 
+            (int32_t) rawHalfWords);
+    }
+
+    printf("  Batch:        %lu halfwords for batch records\n", 
+        batchHalfWords);
+    printf("  Unchanged:    %lu batch records skipped\n", unchanged);
+
+    if (batchActive)
+        printf("  Batch:        active, %u bytes queued\n", batchSiz);
+    else if (batchPending)
+        printf("  Batch:        committed, not applied yet\n");
+}
@@ -0,0 +1,229 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#ifndef FDSSTORE_HPP_
+#define FDSSTORE_HPP_
+
+#include "fds_config.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The maximum number of user data bytes per record. One byte of every 
+ * Fds record is used for the record flags.
+ */
+#define FDSSTORE_MAX_DATABYTES          (FDS_MAX_DATABYTES - 1)
+
+/**
+ * @brief The Fds data id used to commit batches. It is reserved, hence only 
+ * the ids below are available for user data.
+ */
+#define FDSSTORE_BATCH_ID               (FDS_NUM_RECORDS - 1)
+
+/**
+ * @brief The number of user data ids.
+ */
+#define FDSSTORE_NUM_RECORDS            FDSSTORE_BATCH_ID
+
+/**
+ * @brief Record flags, stored in the first byte of every Fds record.
+ */
+#define FDSSTORE_FLAG_RAW               0x00
+#define FDSSTORE_FLAG_RLE               0x01
+
+/**
+ * @brief Stores records in Fds with optional run length compression.
+ *
+ * If the compressed data is not smaller than the original data the record is
+ * stored raw, the flag byte tells which one has been used. Every halfword
+ * which is not programmed saves time and page space and therefore delays the
+ * next garbage collection of Fds.
+ *
+ * Several records can be written as atomic batch. Between begin() and commit()
+ * written records are collected in RAM. On commit() records which did not
+ * change or which are overwritten later in the same batch are dropped. If
+ * more than one record is left all of them are written as one Fds record to
+ * FDSSTORE_BATCH_ID, which starts with a magic number and a version and is
+ * the commit marker. After that the records are copied to their ids and the
+ * batch record gets deleted. If this is interrupted by a reset mount()
+ * completes the batch, batches which have not been committed are lost. If
+ * applying fails the batch stays pending and every following access retries
+ * it first, so newer data is never overwritten by an old batch. Deletes are
+ * part of a batch as well.
+ *
+ * Limits: The batch record is a single Fds record, hence all records of a 
+ * batch have to fit into FDS_MAX_DATABYTES - 2 bytes, every record needs 3 
+ * bytes plus its stored size including the flag byte. A incompressible record
+ * of FDSSTORE_MAX_DATABYTES can not be part of a batch. Every record which is
+ * committed through the batch record is programmed twice and the batch record
+ * has to be deleted, so a batch costs more flash than single writes. It buys
+ * consistency, not fewer programmed halfwords.
+ */
+class FdsStore
+{
+    public:
+
+        /**
+         * @brief Construct a new store object with cleared statistics.
+         */
+        FdsStore();
+
+        /**
+         * @brief Completes a committed batch which has been interrupted. To be
+         * called once at startup.
+         *
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t mount(void);
+
+        /**
+         * @brief Starts a batch, all following writes will be collected until
+         * commit() is called.
+         *
+         * @return 0 on success, <0 if there is already a active batch.
+         */
+        int8_t begin(void);
+
+        /**
+         * @brief Writes all records of the current batch.
+         *
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t commit(void);
+
+        /**
+         * @brief Discards the current batch.
+         */
+        void abort(void);
+
+        /**
+         * @brief Writes a record. If there is a active batch the record is
+         * added to it and will not be visible before commit() is called.
+         *
+         * @param id        The fds data id.
+         * @param pData     The data to write.
+         * @param siz       Number of bytes, up to FDSSTORE_MAX_DATABYTES.
+         * @param compress  If false the data will be stored raw.
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t write(uint8_t id, const void *pData, size_t siz, 
+            bool compress = true);
+
+        /**
+         * @brief Deletes a record. If there is a active batch the delete is
+         * added to it.
+         *
+         * @param id        The fds data id.
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t del(uint8_t id);
+
+        /**
+         * @brief Reads a record.
+         *
+         * @param id        The fds data id.
+         * @param pData     Destination buffer.
+         * @param siz       Size of the destination buffer.
+         * @return The number of data bytes, 0 if not found or in case of
+         * errors.
+         */
+        size_t read(uint8_t id, void *pData, size_t siz);
+
+        /**
+         * @brief Prints the compression statistics.
+         */
+        void info(void);
+
+    private:
+
+        int8_t store(uint8_t id, const uint8_t *pBuf, size_t siz);
+
+        int8_t finish(void);
+
+        int8_t put(uint8_t id, const uint8_t *pBuf, size_t siz);
+
+        bool valid(void);
+
+        bool contains(uint8_t id, size_t pos);
+
+        int8_t compact(void);
+
+        int8_t apply(void);
+
+        /**
+         * @brief The batch data, a two byte header followed by the id, the
+         * number of bytes as little endian uint16_t and the data of every 
+         * record. Records without data are deletes.
+         */
+        uint8_t batch[FDS_MAX_DATABYTES];
+
+        /**
+         * @brief Number of used bytes in batch.
+         */
+        size_t batchSiz;
+
+        /**
+         * @brief True between begin() and commit().
+         */
+        bool batchActive;
+
+        /**
+         * @brief True if the batch record has been written but not all of its
+         * records have been applied.
+         */
+        bool batchPending;
+
+        /**
+         * @brief Number of written records.
+         */
+        uint32_t writes;
+
+        /**
+         * @brief Number of halfwords Fds would have programmed for the 
+         * written records without compression.
+         */
+        uint32_t rawHalfWords;
+
+        /**
+         * @brief Number of halfwords Fds has programmed for the written 
+         * records.
+         */
+        uint32_t storedHalfWords;
+
+        /**
+         * @brief Number of halfwords Fds has programmed for batch records, 
+         * hence the overhead of batches.
+         */
+        uint32_t batchHalfWords;
+
+        /**
+         * @brief Number of batch records which have been skipped as they did
+         * not change.
+         */
+        uint32_t unchanged;
+};
+
+#endif /* FDSSTORE_HPP_ */
@@ -0,0 +1,351 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+#include "flashlog.hpp"
+#include "flashutil.hpp"
+
+#include <bsp/bsp.h>
+#include "bsp/bsp_flash.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAGIC_START             0x4c47
+#define MAGIC_END               0xb3b8
+#define ERASED                  0xffff
+#define COMMITTED               0x0000
+
+#define HDR_HALFWORDS           (FLASHLOG_PAGEHDRSIZ / 2)
+
+/**
+ * @brief Unlocks the flash if needed.
+ *
+ * @return true if the flash has been locked before.
+ */
+static bool flashUnlock(void)
+{
+    bool locked = (FLASH->CR & FLASH_CR_LOCK) != 0;
+
+    if (locked)
+        bspFlashUnlock();
+
+    return locked;
+}
+
+/**
+ * @brief Restores the lock state returned by flashUnlock().
+ */
+static void flashRestore(bool locked)
+{
+    if (locked)
+        bspFlashLock();
+}
+
+FlashLog::FlashLog() :
+     head(0)
+    ,used(0)
+    ,seq(0)
+    ,pWrite(0)
+{
+
+}
+
+int8_t FlashLog::mount(void)
+{
+    uint32_t pageSeq = 0;
+    uint32_t maxSeq = 0;
+    bool found = false;
+    uint8_t page = 0;
+    uint16_t *pEnd = 0;
+
+    for (uint8_t i = 0; i < FLASHLOG_NUM_PAGES; i++)
+    {
+        if (pageValid(i, &pageSeq) && (!found || pageSeq > maxSeq))
+        {
+            found = true;
+            maxSeq = pageSeq;
+            head = i;
+        }
+    }
+
+    if (!found)
+    {
+        used = 0;
+        return -1;
+    }
+
+    seq = maxSeq;
+
+    /* Count the pages with consecutive sequence numbers before the head. */
+    used = 1;
+    page = head;
+    while (used < FLASHLOG_NUM_PAGES)
+    {
+        page = (page + FLASHLOG_NUM_PAGES - 1) % FLASHLOG_NUM_PAGES;
+        if (!pageValid(page, &pageSeq) || pageSeq != seq - used)
+            break;
+
+        used++;
+    }
+
+    /* Search the write position within the head page. */
+    pWrite = pageAddr(head) + HDR_HALFWORDS;
+    pEnd = pageEnd(head);
+    while (pWrite < pEnd && *pWrite != ERASED)
+        pWrite = nextEntry(pWrite, pEnd);
+
+    return 0;
+}
+
+int8_t FlashLog::format(bool force, uint8_t *pSkipped)
+{
+    bool locked = flashUnlock();
+    bool skip = false;
+    bspStatus_t ret = BSP_OK;
+
+    used = 0;
+
+    if (pSkipped != 0)
+        *pSkipped = 0;
+
+    for (uint8_t i = 0; i < FLASHLOG_NUM_PAGES; i++)
+    {
+        ret = flashErasePage(pageAddr(i), force, &skip);
+        if (ret != BSP_OK)
+        {
+            flashRestore(locked);
+            return -1;
+        }
+
+        if (skip && pSkipped != 0)
+            (*pSkipped)++;
+    }
+
+    flashRestore(locked);
+
+    return startPage(0, 0);
+}
+
+int8_t FlashLog::append(const void *pData, size_t siz)
+{
+    const uint8_t *pSrc = (const uint8_t *) pData;
+    uint16_t need = 2 + (siz + 1) / 2;
+    uint16_t val = 0;
+    bspStatus_t ret = BSP_OK;
+    bool locked = false;
+
+    if (used == 0)
+        return -1;
+
+    if (siz == 0 || siz > FLASHLOG_MAX_ENTRYSIZ)
+        return -2;
+
+    if (pWrite + need > pageEnd(head))
+    {
+        if (startPage((head + 1) % FLASHLOG_NUM_PAGES, seq + 1) != 0)
+            return -3;
+    }
+
+    locked = flashUnlock();
+
+    ret = bspFlashProgHalfWord(pWrite++, (uint16_t) siz);
+    for (size_t i = 0; ret == BSP_OK && i < siz; i += 2)
+    {
+        val = pSrc[i];
+        val |= (i + 1 < siz ? pSrc[i + 1] : 0xff) << 8;
+        ret = bspFlashProgHalfWord(pWrite++, val);
+    }
+
+    /* Only now the entry is complete. */
+    if (ret == BSP_OK)
+        ret = bspFlashProgHalfWord(pWrite++, COMMITTED);
+
+    flashRestore(locked);
+
+    if (ret != BSP_OK)
+    {
+        /* Never program the rest of this page again. */
+        pWrite = pageEnd(head);
+        return -4;
+    }
+
+    return 0;
+}
+
+size_t FlashLog::read(uint32_t idx, void *pData, size_t siz)
+{
+    uint16_t *pEntry = find(idx, 0);
+
+    if (pEntry == 0)
+        return 0;
+
+    if (siz > *pEntry)
+        siz = *pEntry;
+
+    memcpy(pData, pEntry + 1, siz);
+
+    return siz;
+}
+
+uint32_t FlashLog::entries(void)
+{
+    uint32_t cnt = 0;
+
+    find(UINT32_MAX, &cnt);
+
+    return cnt;
+}
+
+void FlashLog::info(void)
+{
+    if (used == 0)
+    {
+        printf("  Not mounted, use log format.\n");
+        return;
+    }
+
+    printf("  Pages:      %u to %u\n", FLASHLOG_FIRST_PAGE,
+        FLASHLOG_FIRST_PAGE + FLASHLOG_NUM_PAGES - 1);
+    printf("  Used pages: %u\n", used);
+    printf("  Head page:  %u\n", FLASHLOG_FIRST_PAGE + head);
+    printf("  Sequence:   %lu\n", seq);
+    printf("  Entries:    %lu\n", entries());
+    printf("  Free bytes: %d\n", (pageEnd(head) - pWrite) * 2);
+}
+
+uint16_t *FlashLog::pageAddr(uint8_t page)
+{
+    return (uint16_t *) BSP_FLASH_PAGETOADDR(FLASHLOG_FIRST_PAGE + page);
+}
+
+uint16_t *FlashLog::pageEnd(uint8_t page)
+{
+    return pageAddr(page) + FLASH_PAGE_SIZE / 2;
+}
+
+bool FlashLog::pageValid(uint8_t page, uint32_t *pSeq)
+{
+    uint16_t *pHdr = pageAddr(page);
+
+    if (pHdr[0] != MAGIC_START || pHdr[3] != MAGIC_END)
+        return false;
+
+    *pSeq = pHdr[1] | ((uint32_t) pHdr[2] << 16);
+
+    return true;
+}
+
+uint16_t *FlashLog::nextEntry(uint16_t *pEntry, uint16_t *pEnd)
+{
+    /* A corrupted length ends the page. */
+    if (*pEntry == 0 || *pEntry > FLASHLOG_MAX_ENTRYSIZ)
+        return pEnd;
+
+    pEntry += 2 + (*pEntry + 1) / 2;
+
+    return pEntry < pEnd ? pEntry : pEnd;
+}
+
+bool FlashLog::committed(uint16_t *pEntry, uint16_t *pEnd)
+{
+    uint16_t *pMarker = pEntry + 1 + (*pEntry + 1) / 2;
+
+    return pMarker < pEnd && *pMarker == COMMITTED;
+}
+
+int8_t FlashLog::startPage(uint8_t page, uint32_t pageSeq)
+{
+    uint16_t *pHdr = pageAddr(page);
+    bool locked = flashUnlock();
+    bspStatus_t ret = BSP_OK;
+
+    ret = flashErasePage(pHdr, false, 0);
+
+    if (ret == BSP_OK)
+        ret = bspFlashProgHalfWord(&pHdr[0], MAGIC_START);
+    if (ret == BSP_OK)
+        ret = bspFlashProgHalfWord(&pHdr[1], (uint16_t) pageSeq);
+    if (ret == BSP_OK)
+        ret = bspFlashProgHalfWord(&pHdr[2], (uint16_t) (pageSeq >> 16));
+    if (ret == BSP_OK)
+        ret = bspFlashProgHalfWord(&pHdr[3], MAGIC_END);
+
+    flashRestore(locked);
+
+    if (ret != BSP_OK)
+        return -1;
+
+    /* If all pages are in use the oldest one has been reused. */
+    head = page;
+    seq = pageSeq;
+    if (used < FLASHLOG_NUM_PAGES)
+        used++;
+    pWrite = pHdr + HDR_HALFWORDS;
+
+    return 0;
+}
+
+uint16_t *FlashLog::find(uint32_t idx, uint32_t *pCnt)
+{
+    uint8_t page = oldest();
+    uint16_t *pEntry = 0;
+    uint16_t *pEnd = 0;
+    uint32_t cnt = 0;
+
+    for (uint8_t i = 0; i < used; i++)
+    {
+        pEntry = pageAddr(page) + HDR_HALFWORDS;
+        pEnd = pageEnd(page);
+
+        while (pEntry < pEnd && *pEntry != ERASED)
+        {
+            if (*pEntry == 0 || *pEntry > FLASHLOG_MAX_ENTRYSIZ)
+                break;
+
+            if (!committed(pEntry, pEnd))
+            {
+                pEntry = nextEntry(pEntry, pEnd);
+                continue;
+            }
+
+            if (cnt == idx)
+                return pEntry;
+
+            cnt++;
+            pEntry = nextEntry(pEntry, pEnd);
+        }
+
+        page = (page + 1) % FLASHLOG_NUM_PAGES;
+    }
+
+    if (pCnt != 0)
+        *pCnt = cnt;
+
+    return 0;
+}
+
+uint8_t FlashLog::oldest(void)
+{
+    return (head + FLASHLOG_NUM_PAGES + 1 - used) % FLASHLOG_NUM_PAGES;
+}
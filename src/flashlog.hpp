@@ -0,0 +1,170 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+#ifndef FLASHLOG_HPP_
+#define FLASHLOG_HPP_
+
+#include "bsp/bsp_flash.h"
+#include "fds_config.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Defines the number of flash pages used as circular log. The log is
+ * placed below the pages used by libfds, one page is left free in between for
+ * raw flash tests with clr and write.
+ */
+#ifndef FLASHLOG_NUM_PAGES
+#define FLASHLOG_NUM_PAGES              4
+#endif
+
+/**
+ * @brief The first flash page used by the log.
+ */
+#define FLASHLOG_FIRST_PAGE             \
+        (BSP_FLASH_NUMPAGES - FDS_NUM_PAGES - 1 - FLASHLOG_NUM_PAGES)
+
+/**
+ * @brief Size of the page header in bytes. It holds a magic number, the 32 bit
+ * sequence number of the page and a second magic number which is written last
+ * to mark the header as complete.
+ */
+#define FLASHLOG_PAGEHDRSIZ             8
+
+/**
+ * @brief The maximum number of payload bytes per entry. Every entry has a two
+ * byte length header, a two byte commit marker written after the data and must
+ * fit into a single page.
+ */
+#define FLASHLOG_MAX_ENTRYSIZ           \
+        (FLASH_PAGE_SIZE - FLASHLOG_PAGEHDRSIZ - 4)
+
+/**
+ * @brief Append only log using a range of flash pages as circular buffer.
+ *
+ * Other than Fds this is not a key value store. Entries of fixed or variable
+ * length are appended in O(1) without any lookup. If the current page is full
+ * the next one is used, if this is the oldest page it gets erased and its
+ * entries are lost. Every page header holds a sequence number, hence the head
+ * of the log is found at boot by reading the page headers only. Entries which
+ * have been interrupted by a reset lack the commit marker and are skipped.
+ */
+class FlashLog
+{
+    public:
+
+        /**
+         * @brief Construct a new, unmounted log object.
+         */
+        FlashLog();
+
+        /**
+         * @brief Searches the newest page by its sequence number and the
+         * write position within it. If there is no valid page the log stays
+         * unmounted, format() has to be called to use it.
+         *
+         * @return 0 on success, <0 if there is no valid log.
+         */
+        int8_t mount(void);
+
+        /**
+         * @brief Erases all log pages and starts a new log. Pages which are
+         * blank already are not erased again.
+         *
+         * @param force     If true blank pages will be erased too.
+         * @param pSkipped  Optional, returns the number of skipped erases.
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t format(bool force = false, uint8_t *pSkipped = 0);
+
+        /**
+         * @brief Appends a entry to the log.
+         *
+         * @param pData     The data to append.
+         * @param siz       Number of bytes, 1 to FLASHLOG_MAX_ENTRYSIZ.
+         * @return 0 on success, <0 in case of errors.
+         */
+        int8_t append(const void *pData, size_t siz);
+
+        /**
+         * @brief Reads a entry of the log.
+         *
+         * @param idx       The entry index, 0 is the oldest entry.
+         * @param pData     Destination buffer.
+         * @param siz       Size of the destination buffer.
+         * @return The number of bytes read, 0 if the entry does not exist.
+         */
+        size_t read(uint32_t idx, void *pData, size_t siz);
+
+        /**
+         * @brief Returns the number of entries in the log.
+         */
+        uint32_t entries(void);
+
+        /**
+         * @brief Prints the status of the log.
+         */
+        void info(void);
+
+    private:
+
+        uint16_t *pageAddr(uint8_t page);
+
+        bool pageValid(uint8_t page, uint32_t *pSeq);
+
+        uint16_t *pageEnd(uint8_t page);
+
+        uint16_t *nextEntry(uint16_t *pEntry, uint16_t *pEnd);
+
+        bool committed(uint16_t *pEntry, uint16_t *pEnd);
+
+        int8_t startPage(uint8_t page, uint32_t seq);
+
+        uint16_t *find(uint32_t idx, uint32_t *pCnt);
+
+        uint8_t oldest(void);
+
+        /**
+         * @brief The page which is currently written.
+         */
+        uint8_t head;
+
+        /**
+         * @brief Number of valid pages, 0 if not mounted.
+         */
+        uint8_t used;
+
+        /**
+         * @brief The sequence number of the head page.
+         */
+        uint32_t seq;
+
+        /**
+         * @brief Address of the next entry to write in the head page.
+         */
+        uint16_t *pWrite;
+};
+
+#endif /* FLASHLOG_HPP_ */
@@ -0,0 +1,97 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#include "flashsnap.hpp"
+
+#define FNV_OFFSET                      2166136261UL
+#define FNV_PRIME                       16777619UL
+
+/**
+ * @brief FNV-1a on 32 bit words, good enough to detect changes and way 
+ * faster than a byte wise hash.
+ */
+static uint32_t fnv(const uint32_t *pData, size_t words)
+{
+    uint32_t val = FNV_OFFSET;
+
+    while (words-- > 0)
+    {
+        val ^= *pData++;
+        val *= FNV_PRIME;
+    }
+
+    return val;
+}
+
+FlashSnap::FlashSnap()
+{
+    uint32_t blank[FLASHSNAP_CHUNKSIZ / 4];
+
+    for (size_t i = 0; i < FLASHSNAP_CHUNKSIZ / 4; i++)
+        blank[i] = 0xffffffff;
+
+    blankHash = fnv(blank, FLASHSNAP_CHUNKSIZ / 4);
+    reset();
+}
+
+void FlashSnap::reset(void)
+{
+    for (uint16_t i = 0; i < FLASHSNAP_NUM_CHUNKS; i++)
+        hashes[i] = blankHash;
+}
+
+void FlashSnap::take(void)
+{
+    for (uint16_t i = 0; i < FLASHSNAP_NUM_CHUNKS; i++)
+        hashes[i] = hash(i);
+}
+
+uint16_t FlashSnap::next(uint16_t start)
+{
+    uint32_t val = 0;
+
+    for (uint16_t i = start; i < FLASHSNAP_NUM_CHUNKS; i++)
+    {
+        val = hash(i);
+        if (val != hashes[i])
+        {
+            hashes[i] = val;
+            return i;
+        }
+    }
+
+    return FLASHSNAP_NUM_CHUNKS;
+}
+
+uint8_t *FlashSnap::chunkAddr(uint16_t chunk)
+{
+    return (uint8_t *) BSP_FLASH_PAGETOADDR(FLASHSNAP_FIRST_PAGE) + 
+        chunk * FLASHSNAP_CHUNKSIZ;
+}
+
+uint32_t FlashSnap::hash(uint16_t chunk)
+{
+    return fnv((const uint32_t *) chunkAddr(chunk), FLASHSNAP_CHUNKSIZ / 4);
+}
@@ -0,0 +1,108 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#ifndef FLASHSNAP_HPP_
+#define FLASHSNAP_HPP_
+
+#include "bsp/bsp_flash.h"
+#include "fds_config.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Number of bytes covered by one hash.
+ */
+#define FLASHSNAP_CHUNKSIZ              64
+
+/**
+ * @brief The first flash page used by libfds.
+ */
+#define FLASHSNAP_FIRST_PAGE            (BSP_FLASH_NUMPAGES - FDS_NUM_PAGES)
+
+/**
+ * @brief Number of chunks of the Fds area.
+ */
+#define FLASHSNAP_NUM_CHUNKS            \
+        (FDS_NUM_PAGES * FLASH_PAGE_SIZE / FLASHSNAP_CHUNKSIZ)
+
+/**
+ * @brief Used to trace changes of the Fds flash area.
+ *
+ * A 32 bit FNV-1a hash is kept for every chunk of the area, so a snapshot 
+ * only needs 4 bytes of RAM per FLASHSNAP_CHUNKSIZ bytes of flash. Comparing
+ * the current hashes to the stored ones tells which chunks have changed since
+ * the last snapshot.
+ */
+class FlashSnap
+{
+    public:
+
+        /**
+         * @brief Construct a new snapshot of a erased area.
+         */
+        FlashSnap();
+
+        /**
+         * @brief Sets all hashes to the one of a erased chunk, hence the next
+         * search will report all chunks which are not erased.
+         */
+        void reset(void);
+
+        /**
+         * @brief Takes a snapshot of the current state.
+         */
+        void take(void);
+
+        /**
+         * @brief Searches the next changed chunk and updates its hash.
+         *
+         * @param start     The chunk to start with.
+         * @return The index of the changed chunk, FLASHSNAP_NUM_CHUNKS if no
+         * further chunk has changed.
+         */
+        uint16_t next(uint16_t start);
+
+        /**
+         * @brief Returns the address of the given chunk.
+         */
+        uint8_t *chunkAddr(uint16_t chunk);
+
+    private:
+
+        uint32_t hash(uint16_t chunk);
+
+        /**
+         * @brief The hash of every chunk.
+         */
+        uint32_t hashes[FLASHSNAP_NUM_CHUNKS];
+
+        /**
+         * @brief The hash of a erased chunk.
+         */
+        uint32_t blankHash;
+};
+
+#endif /* FLASHSNAP_HPP_ */
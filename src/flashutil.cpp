@@ -0,0 +1,75 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+#include "flashutil.hpp"
+
+#include <bsp/bsp.h>
+#include "bsp/bsp_flash.h"
+
+#define ERASED_WORD             0xffffffff
+
+bool flashIsBlank(const void *pAddr, size_t siz)
+{
+    const uint32_t *pWord = (const uint32_t *) pAddr;
+    const uint32_t *pEnd = pWord + siz / 4;
+    const uint8_t *pByte = 0;
+
+    /* Four words per loop, the AND of all of them is only 0xffffffff if every
+     * single one is erased. */
+    while (pEnd - pWord >= 4)
+    {
+        if ((pWord[0] & pWord[1] & pWord[2] & pWord[3]) != ERASED_WORD)
+            return false;
+
+        pWord += 4;
+    }
+
+    while (pWord < pEnd)
+    {
+        if (*pWord++ != ERASED_WORD)
+            return false;
+    }
+
+    pByte = (const uint8_t *) pWord;
+    for (size_t i = 0; i < siz % 4; i++)
+    {
+        if (pByte[i] != 0xff)
+            return false;
+    }
+
+    return true;
+}
+
+bspStatus_t flashErasePage(uint16_t *pAddr, bool force, bool *pSkipped)
+{
+    bool skip = !force && flashIsBlank(pAddr, FLASH_PAGE_SIZE);
+
+    if (pSkipped != 0)
+        *pSkipped = skip;
+
+    if (skip)
+        return BSP_OK;
+
+    return bspFlashErasePage(pAddr);
+}
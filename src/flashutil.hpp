@@ -0,0 +1,55 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+#ifndef FLASHUTIL_HPP_
+#define FLASHUTIL_HPP_
+
+#include "bsp/bsp_flash.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Checks if the given flash area is erased, hence all bytes are 0xff.
+ * The area is scanned with 32 bit reads and the scan stops at the first word
+ * which is not erased.
+ *
+ * @param pAddr     Start address, must be 32 bit aligned.
+ * @param siz       Number of bytes to check.
+ * @return true if the area is blank.
+ */
+bool flashIsBlank(const void *pAddr, size_t siz);
+
+/**
+ * @brief Erases a flash page unless it is blank already. Hence that a erase
+ * takes about 20 ms and costs a wear cycle.
+ *
+ * @param pAddr     Start address of the page.
+ * @param force     If true the page will be erased even if it is blank.
+ * @param pSkipped  Optional, set to true if the erase has been skipped.
+ * @return The bsp status of the erase, BSP_OK if skipped.
+ */
+bspStatus_t flashErasePage(uint16_t *pAddr, bool force, bool *pSkipped);
+
+#endif /* FLASHUTIL_HPP_ */
@@ -30,6 +30,12 @@
 #include "fds/fds.hpp"
 #include "cli/cli.hpp"
 #include "generic/generic.hpp"
+#include "flashlog.hpp"
+#include "flashutil.hpp"
+#include "fdsstore.hpp"
+#include "scratch.hpp"
+#include "meminfo.hpp"
+#include "flashsnap.hpp"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -39,8 +45,18 @@
 
 #define MIN_PAGE            (BSP_FLASH_NUMPAGES - 5)
 
+#define LOG_FIRST_ADDR      BSP_FLASH_PAGETOADDR(FLASHLOG_FIRST_PAGE)
+#define LOG_END_ADDR        \
+        BSP_FLASH_PAGETOADDR(FLASHLOG_FIRST_PAGE + FLASHLOG_NUM_PAGES)
+
 Cli cli;
 
+FlashLog flashLog;
+
+FdsStore fdsStore;
+
+FlashSnap flashSnap;
+
 /**
  * @brief Prints the version information
  * 
@@ -71,6 +87,7 @@ int8_t cmd_help(char *argv[], uint8_t argc)
     printf("Supported commands:\n");
     printf("  ver               Used to print version infos.\n");
     printf("  info              Used to print flash information.\n");
+    printf("  mem               Used to print RAM usage and stack high water mark.\n");
     printf("  dump mode [...]   Dump either memory or a entire flash page.\n");
     printf("     mode     p     Page mode, further args: addr num [ascii]\n");
     printf("              m     Memory mode, further args: page [ascii]\n");
@@ -78,23 +95,44 @@ int8_t cmd_help(char *argv[], uint8_t argc)
     printf("     num            Number of bytes to dump as hex or decimal value.\n");
     printf("     page           Page number in page mode.\n");
     printf("     ascci    a     Optional, dump as ascii text, default are hex values.\n");
-    printf("  clr page [num]    clears the given pages.\n");
+    printf("  clr page [num [f]] clears the given pages.\n");
     printf("     page           First Page to be cleared.\n");
     printf("     num            Optional, defaults to one.\n");
+    printf("     force    f     Optional, erase blank pages too.\n");
     printf("  write addr val    To write to the flash.\n");
     printf("     addr           Memory address as decimal or hex value.\n");
     printf("     val            uint16_t value to write in hex or decimal format.\n");
+    printf("  snap [mode]       Dumps the chunks of the fds pages which changed since\n");
+    printf("                    the last snapshot.\n");
+    printf("     mode     r     Optional, reset, the next snap dumps all used chunks.\n");
+    printf("              t     Optional, take a snapshot without dumping.\n");
     printf("  lock              To lock the flash.\n");
     printf("  unlock            To unlock the flash.\n");
     printf("  fds cmd [...]     Used to trigger one of the following fds commands:\n");
     printf("     format         To format the fds flash pages.\n");
     printf("     info           To print the fds status infos.\n");
-    printf("     write i v n    To write data.\n");
-    printf("                    i = fds data id.\n");
+    printf("     write i v n [r] To write data.\n");
+    printf("                    i = fds data id, 0 to %u.\n", 
+        FDSSTORE_NUM_RECORDS - 1);
     printf("                    v = byte value.\n");
     printf("                    n = number of bytes with value v.\n");
+    printf("                    r = optional, store raw, no compression.\n");
     printf("     delete id      To delete the given ID.\n");
+    printf("                    Id %u is reserved for batches.\n", 
+        FDSSTORE_BATCH_ID);
+    printf("     begin          To start a batch, following writes are collected.\n");
+    printf("     commit         To write all records of the batch at once.\n");
+    printf("     abort          To discard the batch.\n");
     printf("     dump           To print the stored data. \n");
+    printf("  log cmd [...]     Used to trigger one of the following log commands:\n");
+    printf("     format [f]     To format the log flash pages, f to erase\n");
+    printf("                    blank pages too.\n");
+    printf("     info           To print the log status infos.\n");
+    printf("     append v n     To append a entry of n bytes with value v.\n");
+    printf("     read idx       To print the entry idx, 0 is the oldest one.\n");
+    printf("     tail [n]       To print the last n entries, defaults to one.\n");
+    printf("     bench n s      To compare n appends of s bytes against n\n");
+    printf("                    Fds writes, overwrites fds data id 0.\n");
     printf("  help              Prints this text.\n");
 
     return 0;
@@ -114,11 +152,36 @@ int8_t cmd_info(char *argv[], uint8_t argc)
     printf("\n");
     printf("FDS status:\n");
     pFds->info();
+    fdsStore.info();
+    printf("\n");
+    printf("Log status:\n");
+    flashLog.info();
     printf("\n");
 
     return 0;
 }
 
+int8_t cmd_mem(char *argv[], uint8_t argc)
+{
+	unused(argv);
+    unused(argc);
+
+    printf("RAM usage:\n");
+    printf("  .data:       %u\n", memDataSize());
+    printf("  .bss:        %u\n", memBssSize());
+    printf("    cli:       %u\n", sizeof(cli));
+    printf("    flashLog:  %u\n", sizeof(flashLog));
+    printf("    fdsStore:  %u\n", sizeof(fdsStore));
+    printf("    flashSnap: %u\n", sizeof(flashSnap));
+    printf("    scratch:   %u, peak %u\n", SCRATCH_SIZ, scratchPeak());
+    printf("    tty fifos: %u\n", BSP_TTY_TX_BUFSIZ + BSP_TTY_RX_BUFSIZ);
+    printf("  Heap:        %u, %u allocated\n", memHeapSize(), memHeapUsed());
+    printf("  Stack:       %u used, %u never used\n", memStackUsed(), 
+        memStackFree());
+
+    return 0;
+}
+
 int8_t cmd_reg(char *argv[], uint8_t argc)
 {
 	unused(argv);
@@ -218,6 +281,9 @@ int8_t cmd_clrPage(char *argv[], uint8_t argc)
 {
     uint8_t page=0;
     uint8_t num = 1;
+    uint8_t skipped = 0;
+    bool force = false;
+    bool skip = false;
     uint16_t *addr = 0;
     bspStatus_t ret = BSP_OK;
 
@@ -227,9 +293,12 @@ int8_t cmd_clrPage(char *argv[], uint8_t argc)
     if(!cli.toUnsigned(argv[0], (void*)&page, sizeof(page)))
         return -2;
     
-    if (argc == 2 && !cli.toUnsigned(argv[1], (void*)&num, sizeof(num)))
+    if (argc >= 2 && !cli.toUnsigned(argv[1], (void*)&num, sizeof(num)))
         return -3;
 
+    if (argc == 3 && *argv[2] == 'f')
+        force = true;
+
     if (page > BSP_FLASH_NUMPAGES-1 || page+num > BSP_FLASH_NUMPAGES)
     {
         return -4;
@@ -241,14 +310,22 @@ int8_t cmd_clrPage(char *argv[], uint8_t argc)
         return -5;
     }
 
-    addr = BSP_FLASH_PAGETOADDR(page);
-    
-    while (num > 0)
+    if (page < FLASHLOG_FIRST_PAGE + FLASHLOG_NUM_PAGES && 
+        page + num > FLASHLOG_FIRST_PAGE)
+    {
+        printf("ERROR: Access to log pages prohibited, use log format!\n");
+        return -6;
+    }
+
+    for (uint8_t i = 0; i < num; i++)
     {
-        printf("%0lx| clr\n", (uint32_t)addr);
+        addr = BSP_FLASH_PAGETOADDR(page + i);
+    
         bspGpioSet(BSP_DEBUGPIN_0);
-        ret = bspFlashErasePage(addr);
+        ret = flashErasePage(addr, force, &skip);
         bspGpioClear(BSP_DEBUGPIN_0);
+
+        printf("%0lx| %s\n", (uint32_t)addr, skip ? "blank" : "clr");
         
         if (ret != BSP_OK) 
         {
@@ -257,10 +334,12 @@ int8_t cmd_clrPage(char *argv[], uint8_t argc)
             return -5;   
         }
 
-        addr += FLASH_PAGE_SIZE;
-        num--;
+        if (skip)
+            skipped++;
     }
 
+    printf("Skipped %u of %u erases.\n", skipped, num);
+
     return 0;
 }
 
@@ -286,6 +365,12 @@ int8_t cmd_write(char *argv[], uint8_t argc)
         return -4;
     }
 
+    if (addr >= LOG_FIRST_ADDR && addr < LOG_END_ADDR)
+    {
+        printf("ERROR: Access to log pages prohibited!\n");
+        return -4;
+    }
+
     bspGpioSet(BSP_DEBUGPIN_0);
     ret = bspFlashProgHalfWord(addr, val);
     bspGpioClear(BSP_DEBUGPIN_0);
@@ -304,6 +389,42 @@ int8_t cmd_write(char *argv[], uint8_t argc)
 }
 
 
+int8_t cmd_snap(char *argv[], uint8_t argc)
+{
+    uint16_t chunk = 0;
+    uint16_t cnt = 0;
+
+    if (argc == 1)
+    {
+        switch (*argv[0])
+        {
+            case 'r':
+                flashSnap.reset();
+                return 0;
+
+            case 't':
+                flashSnap.take();
+                return 0;
+
+            default:
+                return -1;
+        }
+    }
+
+    chunk = flashSnap.next(0);
+    while (chunk < FLASHSNAP_NUM_CHUNKS)
+    {
+        memdump(flashSnap.chunkAddr(chunk), FLASHSNAP_CHUNKSIZ, false);
+        cnt++;
+        chunk = flashSnap.next(chunk + 1);
+    }
+
+    printf("%u of %u chunks changed, %u bytes dumped.\n", cnt, 
+        FLASHSNAP_NUM_CHUNKS, cnt * FLASHSNAP_CHUNKSIZ);
+
+    return 0;
+}
+
 int8_t cmd_lock(char *argv[], uint8_t argc)
 {
     unused(argv);
@@ -328,11 +449,11 @@ int8_t cmd_unlock(char *argv[], uint8_t argc)
 
 int8_t fdswrite(char *argv[], uint8_t argc)
 {
-    Fds *pFds = pFds->getInstance();
     uint8_t uid = 0;;
     uint8_t val = 0;
     uint16_t siz = 0;
-    uint8_t data[FDS_MAX_DATABYTES];
+    bool compress = true;
+    uint8_t *data = (uint8_t *) scratchAlloc(FDSSTORE_MAX_DATABYTES);
 
     if (argc < 3)
         return -1;
@@ -346,27 +467,32 @@ int8_t fdswrite(char *argv[], uint8_t argc)
     if(!cli.toUnsigned(argv[2], (void*)&siz, sizeof(siz)))
         return -4;
 
-    if(siz > sizeof(data))
+    if(data == 0 || siz > FDSSTORE_MAX_DATABYTES)
         return -5;
 
+    if (argc == 4 && *argv[3] == 'r')
+        compress = false;
+
     for (size_t i = 0; i < siz; i++)
         data[i] = val;
     
-    return pFds->write(uid, data, siz);;
+    return fdsStore.write(uid, data, siz, compress);
 }
 
 int8_t fdsdump(char *argv[], uint8_t argc)
 {
-    Fds *pFds = pFds->getInstance();
-    uint8_t data[FDS_MAX_DATABYTES];
+    uint8_t *data = (uint8_t *) scratchAlloc(FDSSTORE_MAX_DATABYTES);
     size_t siz = 0;
 
     unused(argv);
     unused(argc);
 
-    for (uint8_t id = 0; id <FDS_NUM_RECORDS; id++)
+    if (data == 0)
+        return -1;
+
+    for (uint8_t id = 0; id <FDSSTORE_NUM_RECORDS; id++)
     {
-        siz = pFds->read(id, data, sizeof(data));
+        siz = fdsStore.read(id, data, FDSSTORE_MAX_DATABYTES);
         if (siz != 0)
         {
             printf("Got %u bytes for data Id %u:\n", siz, id);
@@ -383,7 +509,6 @@ int8_t fdsdump(char *argv[], uint8_t argc)
 
 int8_t fdsdel(char *argv[], uint8_t argc)
 {
-    Fds *pFds = pFds->getInstance();
     uint8_t uid = 0;
 
     if (argc < 1)
@@ -392,7 +517,7 @@ int8_t fdsdel(char *argv[], uint8_t argc)
     if(!cli.toUnsigned(argv[0], (void*)&uid, sizeof(uid)))
         return -2;
 
-    return pFds->del(uid);
+    return fdsStore.del(uid);
 }
 
 int8_t cmd_fds(char *argv[], uint8_t argc)
@@ -406,13 +531,202 @@ int8_t cmd_fds(char *argv[], uint8_t argc)
     if(strcmp("format", argv[0]) == 0)
         retval = pFds->format();
     else if(strcmp("info", argv[0]) == 0)
+    {
         pFds->info();
+        fdsStore.info();
+    }
     else if(strcmp("write", argv[0]) == 0)
         retval = fdswrite(&argv[1], argc-1);
     else if(strcmp("dump", argv[0]) == 0)
         retval = fdsdump(&argv[1], argc-1);
     else if(strcmp("delete", argv[0]) == 0)
         retval = fdsdel(&argv[1], argc-1);
+    else if(strcmp("begin", argv[0]) == 0)
+        retval = fdsStore.begin();
+    else if(strcmp("commit", argv[0]) == 0)
+        retval = fdsStore.commit();
+    else if(strcmp("abort", argv[0]) == 0)
+        fdsStore.abort();
+    else
+        retval = -2;
+
+    return retval;
+}
+
+int8_t logformat(char *argv[], uint8_t argc)
+{
+    bool force = false;
+    uint8_t skipped = 0;
+    int8_t ret = 0;
+
+    if (argc == 1 && *argv[0] == 'f')
+        force = true;
+
+    ret = flashLog.format(force, &skipped);
+    printf("Skipped %u of %u erases.\n", skipped, FLASHLOG_NUM_PAGES);
+
+    return ret;
+}
+
+int8_t logappend(char *argv[], uint8_t argc)
+{
+    uint8_t val = 0;
+    uint16_t siz = 0;
+    uint8_t *data = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+
+    if (argc < 2)
+        return -1;
+
+    if(!cli.toUnsigned(argv[0], (void*)&val, sizeof(val)))
+        return -2;
+
+    if(!cli.toUnsigned(argv[1], (void*)&siz, sizeof(siz)))
+        return -3;
+
+    if(data == 0 || siz > FDS_MAX_DATABYTES)
+        return -4;
+
+    memset(data, val, siz);
+
+    return flashLog.append(data, siz);
+}
+
+void logprint(uint32_t idx)
+{
+    uint8_t *data = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    size_t siz = 0;
+
+    if (data == 0)
+        return;
+
+    siz = flashLog.read(idx, data, FDS_MAX_DATABYTES);
+    if (siz != 0)
+    {
+        printf("Entry %lu, %u bytes:\n", idx, siz);
+        memdump(data, siz, false);
+    }
+    else
+    {
+        printf("Entry %lu not found.\n", idx);
+    }
+
+    scratchFree(data);
+}
+
+int8_t logread(char *argv[], uint8_t argc)
+{
+    uint32_t idx = 0;
+
+    if (argc < 1)
+        return -1;
+
+    if(!cli.toUnsigned(argv[0], (void*)&idx, sizeof(idx)))
+        return -2;
+
+    logprint(idx);
+
+    return 0;
+}
+
+int8_t logtail(char *argv[], uint8_t argc)
+{
+    uint32_t num = 1;
+    uint32_t cnt = flashLog.entries();
+
+    if (argc == 1 && !cli.toUnsigned(argv[0], (void*)&num, sizeof(num)))
+        return -1;
+
+    if (num > cnt)
+        num = cnt;
+
+    for (uint32_t idx = cnt - num; idx < cnt; idx++)
+        logprint(idx);
+
+    return 0;
+}
+
+/**
+ * @brief Prints the rate of a benchmark run.
+ */
+void benchprint(const char *name, uint32_t num, uint32_t ms)
+{
+    printf("  %-10s %lu entries in %lu ms", name, num, ms);
+    if (ms != 0)
+        printf(", %lu entries/s", (num * 1000) / ms);
+    printf("\n");
+}
+
+int8_t logbench(char *argv[], uint8_t argc)
+{
+    Fds *pFds = pFds->getInstance();
+    uint32_t num = 0;
+    uint16_t siz = 0;
+    uint32_t tick = 0;
+    uint8_t *data = (uint8_t *) scratchAlloc(FDS_MAX_DATABYTES);
+    int8_t ret = 0;
+
+    if (argc < 2)
+        return -1;
+
+    if(!cli.toUnsigned(argv[0], (void*)&num, sizeof(num)))
+        return -2;
+
+    if(!cli.toUnsigned(argv[1], (void*)&siz, sizeof(siz)))
+        return -3;
+
+    if(data == 0 || siz == 0 || siz > FDS_MAX_DATABYTES)
+        return -4;
+
+    tick = bspGetSysTick();
+    for (uint32_t i = 0; i < num && ret == 0; i++)
+    {
+        memset(data, (uint8_t) i, siz);
+        ret = flashLog.append(data, siz);
+    }
+    tick = bspGetSysTick() - tick;
+
+    if (ret != 0)
+        return -5;
+
+    benchprint("log:", num, tick);
+
+    tick = bspGetSysTick();
+    for (uint32_t i = 0; i < num && ret == 0; i++)
+    {
+        /* Stored raw so fds dump can still read data id 0 afterwards. */
+        memset(data, (uint8_t) i, siz);
+        data[0] = FDSSTORE_FLAG_RAW;
+        ret = pFds->write(0, data, siz);
+    }
+    tick = bspGetSysTick() - tick;
+
+    if (ret != 0)
+        return -6;
+
+    benchprint("fds:", num, tick);
+
+    return 0;
+}
+
+int8_t cmd_log(char *argv[], uint8_t argc)
+{
+    int8_t retval = 0;
+
+    if (argc < 1)
+        return -1;
+
+    if(strcmp("format", argv[0]) == 0)
+        retval = logformat(&argv[1], argc-1);
+    else if(strcmp("info", argv[0]) == 0)
+        flashLog.info();
+    else if(strcmp("append", argv[0]) == 0)
+        retval = logappend(&argv[1], argc-1);
+    else if(strcmp("read", argv[0]) == 0)
+        retval = logread(&argv[1], argc-1);
+    else if(strcmp("tail", argv[0]) == 0)
+        retval = logtail(&argv[1], argc-1);
+    else if(strcmp("bench", argv[0]) == 0)
+        retval = logbench(&argv[1], argc-1);
     else
         retval = -2;
 
@@ -424,13 +738,16 @@ cliCmd_t cmd_table[] =
    {"ver", cmd_ver},
    {"help", cmd_help},
    {"info", cmd_info},
+   {"mem", cmd_mem},
    {"reg", cmd_reg},
    {"dump", cmd_dump},
    {"clr", cmd_clrPage},
    {"write", cmd_write},
+   {"snap", cmd_snap},
    {"lock", cmd_lock},
    {"unlock", cmd_unlock},
    {"fds", cmd_fds},
+   {"log", cmd_log},
    {0,      0}
 };
 
@@ -440,6 +757,7 @@ int main(void)
     uint32_t sysTick = 0;
     uint32_t ledTick = 0;
 
+    memPaint();
     bspChipInit();
 
     init.Mode = LL_GPIO_MODE_OUTPUT;
@@ -451,6 +769,9 @@ int main(void)
     bspGpioClear(BSP_DEBUGPIN_0);
     bspGpioClear(BSP_DEBUGPIN_1);
 
+    flashLog.mount();
+    fdsStore.mount();
+
     printf("\n\n");
     cmd_ver(0, 0);
     printf("\n");
@@ -470,6 +791,7 @@ int main(void)
 
         if (bspTTYDataAvailable())
         {
+            scratchReset();
         	cli.procByte((uint8_t) bspTTYGetChar());
         }
     }
@@ -0,0 +1,113 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#include "meminfo.hpp"
+
+#include <bsp/bsp.h>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#define PATTERN                         0xa5a5a5a5
+
+/**
+ * @brief Number of bytes below the stack pointer which are not painted as
+ * interrupts might use them while painting.
+ */
+#define PAINT_MARGIN                    64
+
+/**
+ * @brief Symbols provided by the linker script.
+ */
+extern "C" uint32_t _sdata, _edata, _sbss, _ebss, _end, _estack;
+
+/**
+ * @brief The lowest painted address.
+ */
+static uint32_t *pPaintStart = 0;
+
+/**
+ * @brief Returns the first 32 bit aligned address above the heap.
+ */
+static uint32_t *heapTop(void)
+{
+    return (uint32_t *) (((uint32_t) sbrk(0) + 3) & ~3);
+}
+
+void memPaint(void)
+{
+    uint32_t *pEnd = (uint32_t *) (__get_MSP() - PAINT_MARGIN);
+    uint32_t *pAddr = heapTop();
+
+    pPaintStart = pAddr;
+    while (pAddr < pEnd)
+        *pAddr++ = PATTERN;
+}
+
+/**
+ * @brief Returns the lowest address which has been used by the stack.
+ */
+static uint32_t *stackLow(void)
+{
+    uint32_t *pAddr = heapTop();
+
+    if (pAddr < pPaintStart)
+        pAddr = pPaintStart;
+
+    while (pAddr < &_estack && *pAddr == PATTERN)
+        pAddr++;
+
+    return pAddr;
+}
+
+size_t memStackUsed(void)
+{
+    return (uint8_t *) &_estack - (uint8_t *) stackLow();
+}
+
+size_t memStackFree(void)
+{
+    return (uint8_t *) stackLow() - (uint8_t *) heapTop();
+}
+
+size_t memDataSize(void)
+{
+    return (uint8_t *) &_edata - (uint8_t *) &_sdata;
+}
+
+size_t memBssSize(void)
+{
+    return (uint8_t *) &_ebss - (uint8_t *) &_sbss;
+}
+
+size_t memHeapSize(void)
+{
+    return (uint8_t *) sbrk(0) - (uint8_t *) &_end;
+}
+
+size_t memHeapUsed(void)
+{
+    return mallinfo().uordblks;
+}
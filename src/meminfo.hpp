@@ -0,0 +1,74 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#ifndef MEMINFO_HPP_
+#define MEMINFO_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Fills the unused stack with a pattern. To be called first thing in
+ * main() so the whole boot path is covered. Heap which is allocated later, for
+ * example the stdio buffers, is excluded when searching the stack usage.
+ */
+void memPaint(void);
+
+/**
+ * @brief Returns the maximum number of stack bytes used since memPaint(), 
+ * found by searching the lowest address which does not hold the pattern.
+ * Hence that memPaint() leaves PAINT_MARGIN (64) bytes below its own stack 
+ * pointer unpainted as interrupts might use them. These are always counted
+ * as used, so the result is an upper bound by up to this margin.
+ */
+size_t memStackUsed(void);
+
+/**
+ * @brief Returns the number of bytes between the heap and the stack which
+ * have never been used.
+ */
+size_t memStackFree(void);
+
+/**
+ * @brief Returns the size of the .data section.
+ */
+size_t memDataSize(void);
+
+/**
+ * @brief Returns the size of the .bss section.
+ */
+size_t memBssSize(void);
+
+/**
+ * @brief Returns the size of the heap, hence the memory claimed by sbrk.
+ */
+size_t memHeapSize(void);
+
+/**
+ * @brief Returns the number of heap bytes allocated by malloc.
+ */
+size_t memHeapUsed(void);
+
+#endif /* MEMINFO_HPP_ */
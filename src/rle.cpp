@@ -0,0 +1,148 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#include "rle.hpp"
+
+#include <string.h>
+
+#define RLE_RUN                 0x80
+#define RLE_MIN_RUN             3
+#define RLE_MAX_RUN             (0x7f + RLE_MIN_RUN)
+#define RLE_MAX_LITERAL         0x80
+
+/**
+ * @brief Returns the number of equal bytes at the start of pSrc.
+ */
+static size_t runLength(const uint8_t *pSrc, size_t siz)
+{
+    size_t run = 1;
+
+    while (run < siz && run < RLE_MAX_RUN && pSrc[run] == pSrc[0])
+        run++;
+
+    return run;
+}
+
+size_t rleEncode(const uint8_t *pSrc, size_t siz, uint8_t *pDst, size_t dstSiz)
+{
+    size_t pos = 0;
+    size_t out = 0;
+    size_t run = 0;
+    size_t len = 0;
+
+    while (pos < siz)
+    {
+        run = runLength(&pSrc[pos], siz - pos);
+
+        if (run >= RLE_MIN_RUN)
+        {
+            if (out + 2 > dstSiz)
+                return 0;
+
+            pDst[out++] = RLE_RUN | (run - RLE_MIN_RUN);
+            pDst[out++] = pSrc[pos];
+            pos += run;
+            continue;
+        }
+
+        /* Collect literals until the next run worth encoding. */
+        len = run;
+        while (pos + len < siz && len < RLE_MAX_LITERAL)
+        {
+            if (runLength(&pSrc[pos + len], siz - pos - len) >= RLE_MIN_RUN)
+                break;
+
+            len++;
+        }
+
+        if (out + 1 + len > dstSiz)
+            return 0;
+
+        pDst[out++] = len - 1;
+        memcpy(&pDst[out], &pSrc[pos], len);
+        out += len;
+        pos += len;
+    }
+
+    return out;
+}
+
+size_t rleDecode(const uint8_t *pSrc, size_t siz, uint8_t *pDst, size_t dstSiz)
+{
+    size_t pos = 0;
+    size_t out = 0;
+    size_t len = 0;
+
+    while (pos < siz)
+    {
+        if (pSrc[pos] & RLE_RUN)
+        {
+            len = (pSrc[pos] & ~RLE_RUN) + RLE_MIN_RUN;
+            if (pos + 2 > siz || out + len > dstSiz)
+                return 0;
+
+            memset(&pDst[out], pSrc[pos + 1], len);
+            pos += 2;
+        }
+        else
+        {
+            len = pSrc[pos] + 1;
+            if (pos + 1 + len > siz || out + len > dstSiz)
+                return 0;
+
+            memcpy(&pDst[out], &pSrc[pos + 1], len);
+            pos += 1 + len;
+        }
+
+        out += len;
+    }
+
+    return out;
+}
+
+size_t rleSize(const uint8_t *pSrc, size_t siz)
+{
+    size_t pos = 0;
+    size_t out = 0;
+
+    while (pos < siz)
+    {
+        if (pSrc[pos] & RLE_RUN)
+        {
+            if (pos + 2 > siz)
+                return 0;
+
+            out += (pSrc[pos] & ~RLE_RUN) + RLE_MIN_RUN;
+            pos += 2;
+        }
+        else
+        {
+            out += pSrc[pos] + 1;
+            pos += 1 + pSrc[pos] + 1;
+        }
+    }
+
+    return pos == siz ? out : 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#ifndef RLE_HPP_
+#define RLE_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Run length encoding with a small footprint, a variant of PackBits.
+ *
+ * Every block starts with a control byte c:
+ *   c < 0x80   c + 1 literal bytes follow.
+ *   c >= 0x80  The next byte is repeated (c & 0x7f) + 3 times.
+ *
+ * The worst case overhead is one byte per 128 input bytes.
+ */
+
+/**
+ * @brief Encodes the given data.
+ *
+ * @param pSrc      The data to encode.
+ * @param siz       Number of bytes to encode.
+ * @param pDst      Destination buffer.
+ * @param dstSiz    Size of the destination buffer.
+ * @return The number of encoded bytes, 0 if they do not fit to pDst.
+ */
+size_t rleEncode(const uint8_t *pSrc, size_t siz, uint8_t *pDst, size_t dstSiz);
+
+/**
+ * @brief Decodes the given data.
+ *
+ * @param pSrc      The encoded data.
+ * @param siz       Number of encoded bytes.
+ * @param pDst      Destination buffer.
+ * @param dstSiz    Size of the destination buffer.
+ * @return The number of decoded bytes, 0 if the data does not fit to pDst or
+ * if it is corrupted.
+ */
+size_t rleDecode(const uint8_t *pSrc, size_t siz, uint8_t *pDst, size_t dstSiz);
+
+/**
+ * @brief Returns the number of bytes the given data decodes to.
+ *
+ * @param pSrc      The encoded data.
+ * @param siz       Number of encoded bytes.
+ * @return The number of decoded bytes, 0 if the data is corrupted.
+ */
+size_t rleSize(const uint8_t *pSrc, size_t siz);
+
+#endif /* RLE_HPP_ */
@@ -0,0 +1,74 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#include "scratch.hpp"
+
+/**
+ * @brief The arena, uint32_t to be aligned.
+ */
+static uint32_t arena[SCRATCH_SIZ / 4];
+
+/**
+ * @brief Number of used bytes.
+ */
+static size_t used = 0;
+
+/**
+ * @brief Maximum number of used bytes.
+ */
+static size_t peak = 0;
+
+void *scratchAlloc(size_t siz)
+{
+    uint8_t *pBuf = (uint8_t *) arena + used;
+
+    siz = (siz + 3) & ~3;
+    if (siz > sizeof(arena) - used)
+        return 0;
+
+    used += siz;
+    if (used > peak)
+        peak = used;
+
+    return pBuf;
+}
+
+void scratchFree(void *pBuf)
+{
+    size_t pos = (uint8_t *) pBuf - (uint8_t *) arena;
+
+    if (pBuf != 0 && pos < used)
+        used = pos;
+}
+
+void scratchReset(void)
+{
+    used = 0;
+}
+
+size_t scratchPeak(void)
+{
+    return peak;
+}
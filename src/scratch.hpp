@@ -0,0 +1,72 @@
+/*
+ * flashtest, used to develope and test libfds and the needed flash access code
+ * provided by bsp-nucleo-f103. Start terminal by invoking:
+ *
+ *   picocom -b 115200 /dev/ttyACM0 --imap=lfcrlf
+ *
+ * Copyright (C) 2020 Julian Friedrich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * You can file issues at https://github.com/fjulian79/libfds
+ */
+
+
+#ifndef SCRATCH_HPP_
+#define SCRATCH_HPP_
+
+#include "fds_config.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Size of the scratch arena in bytes. A command needs one payload 
+ * buffer and FdsStore one more for the flash record.
+ */
+#define SCRATCH_SIZ                     (2 * FDS_MAX_DATABYTES)
+
+/**
+ * @brief A single arena which is shared by all commands for temporary buffers
+ * instead of placing them on the stack. Allocations are 32 bit aligned and 
+ * released in reverse order, either by scratchFree() or all at once by 
+ * scratchReset() which is called before each command.
+ */
+
+/**
+ * @brief Allocates a buffer from the arena.
+ *
+ * @param siz       Number of bytes.
+ * @return The buffer, 0 if the arena is exhausted.
+ */
+void *scratchAlloc(size_t siz);
+
+/**
+ * @brief Releases the given buffer and all buffers allocated after it.
+ *
+ * @param pBuf      Buffer returned by scratchAlloc().
+ */
+void scratchFree(void *pBuf);
+
+/**
+ * @brief Releases all buffers.
+ */
+void scratchReset(void);
+
+/**
+ * @brief Returns the maximum number of bytes used so far.
+ */
+size_t scratchPeak(void);
+
+#endif /* SCRATCH_HPP_ */